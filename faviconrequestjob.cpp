@@ -1,9 +1,10 @@
 #include "faviconrequestjob.h"
 
 #include "faviconstorage.h"
+#include "redirectcache.h"
+#include "replaycorpus.h"
 
 #include <QByteArray>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 
@@ -19,15 +20,17 @@ QUrl iconUrlForUrl(const QUrl &url)
 
 struct FaviconRequestJob::FaviconRequestJobPrivate {
     FaviconRequestJobPrivate(const QUrl &requestUrl)
-        :requestUrl(requestUrl), reply(nullptr), lastError(0), httpRequestAborted(false)
+        :requestUrl(requestUrl), reply(nullptr), lastError(0),
+         httpRequestAborted(false)
     {
     }
 
     QUrl requestUrl;
     QUrl iconUrl;
+    RedirectChain redirects;
     QString iconFile;
     QByteArray iconData;
-    QNetworkAccessManager nam;
+    CorpusNetworkAccessManager nam;
     QNetworkReply *reply;
     int lastError;
     bool httpRequestAborted;
@@ -54,10 +57,19 @@ void FaviconRequestJob::makeRequest()
 {
     d->iconUrl = iconUrlForUrl(d->requestUrl);
 
-    qCDebug(FAVICONREQUESTJOB) << "downloading" << d->iconUrl;
-    QNetworkRequest request = QNetworkRequest(d->iconUrl);
+    // go straight to where the icon moved to permanently
+    d->redirects.start(d->iconUrl);
+
+    startRequest();
+}
+
+void FaviconRequestJob::startRequest()
+{
+    qCDebug(FAVICONREQUESTJOB) << "downloading" << d->redirects.effectiveUrl();
+    QNetworkRequest request = QNetworkRequest(d->redirects.effectiveUrl());
     request.setHeader(QNetworkRequest::UserAgentHeader, "KDE Plasma NewsfeedsEngine");
-    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    // redirects are followed by hand to find out which of them are permanent
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, false);
     request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::AlwaysNetwork);
 
     d->reply = d->nam.get(request);
@@ -86,11 +98,27 @@ void FaviconRequestJob::httpFinished()
         return;
     }
 
-    if (!d->reply->error()) {
+    // every response is recorded, redirects included
+    d->lastError = d->reply->error();
+    ReplayCorpus::instance()->record(d->redirects.effectiveUrl(), d->reply, d->iconData);
+    const bool requestAgain = d->redirects.next(d->reply, &d->lastError);
+    d->reply->deleteLater();
+    d->reply = nullptr;
+
+    if (requestAgain) {
+        d->iconData.clear();
+        startRequest();
+        return;
+    }
+
+    saveIcon();
+}
+
+void FaviconRequestJob::saveIcon()
+{
+    if (!d->lastError) {
         FavIconStorage storage;
         d->iconFile = storage.saveIcon(&d->iconData, d->iconUrl);
-    } else {
-        d->lastError = d->reply->error();
     }
 
     d->iconData.clear(); // release memory
@@ -98,9 +126,6 @@ void FaviconRequestJob::httpFinished()
         d->lastError = QNetworkReply::UnknownContentError;
     }
 
-    d->reply->deleteLater();
-    d->reply = nullptr;
-
     emit iconReady(this);
 }
 
@@ -122,6 +147,16 @@ QUrl FaviconRequestJob::requestUrl() const
   return d->requestUrl;
 }
 
+QUrl FaviconRequestJob::effectiveUrl() const
+{
+  return d->redirects.effectiveUrl();
+}
+
+int FaviconRequestJob::redirectCount() const
+{
+  return d->redirects.redirectCount();
+}
+
 int FaviconRequestJob::errorCode() const
 {
     return d->lastError;
@@ -20,6 +20,8 @@ public:
     int errorCode() const;
     QString iconFile() const;
     QUrl requestUrl() const;
+    QUrl effectiveUrl() const;
+    int redirectCount() const;
     void abort();
 
 Q_SIGNALS:
@@ -34,6 +36,9 @@ private Q_SLOTS:
 #endif
 
 private:
+    void startRequest();
+    void saveIcon();
+
     struct FaviconRequestJobPrivate;
     FaviconRequestJobPrivate *const d;
 };
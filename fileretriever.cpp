@@ -1,11 +1,14 @@
 #include "fileretriever.h"
 
+#include "redirectcache.h"
+#include "replaycorpus.h"
+
 #include <QBuffer>
-#include <QNetworkAccessManager>
 
 struct FileRetriever::FileRetrieverPrivate {
     FileRetrieverPrivate()
-        : buffer(nullptr), reply(nullptr), lastError(0), httpRequestAborted(false)
+        : buffer(nullptr), reply(nullptr), lastError(0),
+          httpRequestAborted(false)
     {
     }
 
@@ -14,8 +17,10 @@ struct FileRetriever::FileRetrieverPrivate {
         delete buffer;
     }
 
+    QUrl url;
+    RedirectChain redirects;
     QBuffer *buffer;
-    QNetworkAccessManager nam;
+    CorpusNetworkAccessManager nam;
     QNetworkReply *reply;
     int lastError;
     bool httpRequestAborted;
@@ -42,9 +47,6 @@ void FileRetriever::retrieveData(const QUrl &url)
         return;
     }
 
-    d->buffer = new QBuffer;
-    d->buffer->open(QIODevice::WriteOnly);
-
     d->httpRequestAborted = false;
 
     QUrl u = url;
@@ -53,10 +55,24 @@ void FileRetriever::retrieveData(const QUrl &url)
         u.setScheme(QStringLiteral("http"));
     }
 
-    qCDebug(FILERETRIEVER) << "downloading" << u;
-    QNetworkRequest request = QNetworkRequest(u);
+    d->url = u;
+
+    d->buffer = new QBuffer;
+    d->buffer->open(QIODevice::WriteOnly);
+
+    // go straight to where the feed moved to permanently
+    d->redirects.start(u);
+
+    makeRequest();
+}
+
+void FileRetriever::makeRequest()
+{
+    qCDebug(FILERETRIEVER) << "downloading" << d->redirects.effectiveUrl();
+    QNetworkRequest request = QNetworkRequest(d->redirects.effectiveUrl());
     request.setHeader(QNetworkRequest::UserAgentHeader, "KDE Plasma NewsfeedsEngine");
-    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    // redirects are followed by hand to find out which of them are permanent
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, false);
 
     d->reply = d->nam.get(request);
     connect(d->reply, &QNetworkReply::finished, this, &FileRetriever::httpFinished);
@@ -78,16 +94,27 @@ void FileRetriever::httpFinished()
 
     qCDebug(FILERETRIEVER) << "finished downloading" << d->reply->request().url();
 
+    // every response is recorded, redirects included
     d->lastError = d->reply->error();
+    ReplayCorpus::instance()->record(d->redirects.effectiveUrl(), d->reply, d->buffer->buffer());
+    const bool requestAgain = d->redirects.next(d->reply, &d->lastError);
     d->reply->deleteLater();
     d->reply = nullptr;
 
+    if (requestAgain) {
+        d->buffer->buffer().clear();
+        d->buffer->seek(0);
+        makeRequest();
+        return;
+    }
+
     QByteArray data = d->buffer->buffer();
     data.detach();
 
     delete d->buffer;
     d->buffer = nullptr;
 
+    emit redirectsResolved(d->redirects.effectiveUrl(), d->redirects.redirectCount());
     emit dataRetrieved(data, d->lastError == QNetworkReply::NoError);
 }
 
@@ -41,6 +41,16 @@ public:
      */
     void abort() override;
 
+Q_SIGNALS:
+    /**
+     * Emitted right before dataRetrieved() once all redirects were
+     * followed.
+     * @param effectiveUrl The URL the data was finally downloaded from.
+     * @param redirectCount The number of redirects followed, redirects
+     * remembered from earlier retrievals are not counted.
+     */
+    void redirectsResolved(const QUrl &effectiveUrl, int redirectCount);
+
 private Q_SLOTS:
     void httpFinished();
     void httpReadyRead();
@@ -49,6 +59,8 @@ private Q_SLOTS:
 #endif
 
 private:
+    void makeRequest();
+
     FileRetriever(const FileRetriever &other);
     FileRetriever &operator=(const FileRetriever &other);
 
@@ -0,0 +1,180 @@
+#include "itemtextprocessor.h"
+
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QTextDocumentFragment>
+
+#define MAXIMUM_CACHED_ITEMS 2000
+#define MAXIMUM_SUMMARY_LENGTH 300
+
+ItemTextProcessor::ItemTextProcessor()
+    : cache(MAXIMUM_CACHED_ITEMS)
+{
+}
+
+bool ItemTextProcessor::lookup(const QString &description, const QString &content, ProcessedItemText *text)
+{
+    const ProcessedItemText *cached = cache.object(fingerprint(description, content));
+    if (cached == nullptr) {
+        return false;
+    }
+
+    *text = *cached;
+    return true;
+}
+
+void ItemTextProcessor::insert(const QString &description, const QString &content, const ProcessedItemText &text)
+{
+    cache.insert(fingerprint(description, content), new ProcessedItemText(text));
+}
+
+ProcessedItemText ItemTextProcessor::process(const QString &description, const QString &content)
+{
+    // the summary is built from sanitized HTML as well, the HTML parser
+    // would load linked style sheets otherwise
+    ProcessedItemText text;
+    text.body = sanitizeHtml(content.isEmpty() ? description : content);
+    if (description.isEmpty() || content.isEmpty()) {
+        text.summary = plainTextSummary(text.body);
+    } else {
+        text.summary = plainTextSummary(sanitizeHtml(description));
+    }
+    return text;
+}
+
+QByteArray ItemTextProcessor::fingerprint(const QString &description, const QString &content)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(description.toUtf8());
+    hash.addData("\0", 1);
+    hash.addData(content.toUtf8());
+    return hash.result();
+}
+
+static QString decodeEntities(const QString &value)
+{
+    static const QRegularExpression numericEntity(
+        QStringLiteral("&#(x[0-9a-f]+|[0-9]+);?"),
+        QRegularExpression::CaseInsensitiveOption);
+
+    QString result;
+    int last = 0;
+    QRegularExpressionMatchIterator it = numericEntity.globalMatch(value);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const QString number = match.captured(1);
+        const uint code = number.startsWith(QLatin1Char('x'), Qt::CaseInsensitive)
+            ? number.midRef(1).toUInt(nullptr, 16) : number.toUInt();
+        result += value.midRef(last, match.capturedStart() - last);
+        result += QString::fromUcs4(&code, 1);
+        last = match.capturedEnd();
+    }
+    result += value.midRef(last);
+
+    result.replace(QLatin1String("&colon;"), QLatin1String(":"), Qt::CaseInsensitive);
+    result.replace(QLatin1String("&tab;"), QLatin1String("\t"), Qt::CaseInsensitive);
+    result.replace(QLatin1String("&newline;"), QLatin1String("\n"), Qt::CaseInsensitive);
+    result.replace(QLatin1String("&amp;"), QLatin1String("&"), Qt::CaseInsensitive);
+    return result;
+}
+
+static bool isSafeUrl(const QString &value)
+{
+    static const QRegularExpression scheme(QStringLiteral("^([a-z][a-z0-9+.-]*):"),
+                                           QRegularExpression::CaseInsensitiveOption);
+
+    // browsers ignore control characters and whitespace inside the scheme
+    QString url = decodeEntities(value);
+    url.remove(QRegularExpression(QStringLiteral("[\\x00-\\x20]")));
+
+    const QRegularExpressionMatch match = scheme.match(url);
+    if (!match.hasMatch()) {
+        return true; // relative URL
+    }
+
+    const QString name = match.captured(1).toLower();
+    return name == QLatin1String("http") || name == QLatin1String("https") || name == QLatin1String("mailto");
+}
+
+QString ItemTextProcessor::sanitizeHtml(const QString &html)
+{
+    static const QRegularExpression activeElements(
+        QStringLiteral("<(script|style|iframe|frame|frameset|object|embed|applet|form|svg|math)\\b.*?</\\1\\s*>"),
+        QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    // whatever follows an element that is never closed is dropped as well
+    static const QRegularExpression unclosedElements(
+        QStringLiteral("<(script|style|iframe|svg|math)\\b.*$"),
+        QRegularExpression::CaseInsensitiveOption | QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression activeTags(
+        QStringLiteral("</?(script|style|iframe|frame|frameset|object|embed|applet|form|svg|math|meta|link|base)\\b[^>]*>"),
+        QRegularExpression::CaseInsensitiveOption);
+    // attributes may also be separated by a slash or follow a quote
+    static const QRegularExpression eventHandlers(
+        QStringLiteral("([\\s/\"'])on[a-z]+\\s*=\\s*(\"[^\"]*\"|'[^']*'|[^\\s>]+)"),
+        QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression urlAttributes(
+        QStringLiteral("\\b(href|src|action|formaction|background|poster|xlink:href)\\s*=\\s*(\"([^\"]*)\"|'([^']*)'|([^\\s>]+))"),
+        QRegularExpression::CaseInsensitiveOption);
+
+    if (html.isEmpty()) {
+        return html;
+    }
+
+    QString result = html;
+    result.remove(activeElements);
+    result.remove(unclosedElements);
+    result.remove(activeTags);
+    result.replace(eventHandlers, QStringLiteral("\\1"));
+
+    // only keep links and images pointing to the web
+    QString sanitized;
+    int last = 0;
+    QRegularExpressionMatchIterator it = urlAttributes.globalMatch(result);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const QString value = match.captured(3) + match.captured(4) + match.captured(5);
+        if (isSafeUrl(value)) {
+            continue;
+        }
+        sanitized += result.midRef(last, match.capturedStart() - last);
+        sanitized += match.captured(1) + QLatin1String("=\"#\"");
+        last = match.capturedEnd();
+    }
+    sanitized += result.midRef(last);
+
+    return sanitized;
+}
+
+QString ItemTextProcessor::plainTextSummary(const QString &html)
+{
+    // QTextDocument resolves style sheets and background images through
+    // loadResource(), which reads local files; only the text is needed here
+    static const QRegularExpression externalResources(
+        QStringLiteral("<(link|img)\\b[^>]*>|@import\\b"),
+        QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression styleAttributes(
+        QStringLiteral("\\s(style|background)\\s*=\\s*(\"[^\"]*\"|'[^']*'|[^\\s>]+)"),
+        QRegularExpression::CaseInsensitiveOption);
+
+    if (html.isEmpty()) {
+        return html;
+    }
+
+    QString text = html;
+    text.remove(externalResources);
+    text.remove(styleAttributes);
+    text = QTextDocumentFragment::fromHtml(text).toPlainText().simplified();
+    // object replacement characters are left in place of images
+    text.remove(QChar::ObjectReplacementCharacter);
+
+    if (text.length() > MAXIMUM_SUMMARY_LENGTH) {
+        int end = text.lastIndexOf(QLatin1Char(' '), MAXIMUM_SUMMARY_LENGTH);
+        if (end <= 0) {
+            end = MAXIMUM_SUMMARY_LENGTH;
+        }
+        text.truncate(end);
+        text.append(QChar(0x2026)); // ellipsis
+    }
+
+    return text;
+}
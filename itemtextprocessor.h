@@ -0,0 +1,60 @@
+#ifndef ITEMTEXTPROCESSOR_H
+#define ITEMTEXTPROCESSOR_H
+
+#include <QString>
+#include <QByteArray>
+#include <QCache>
+
+/**
+ * Pre-rendered text of a single feed item.
+ */
+struct ProcessedItemText {
+    /**
+     * Item body with common active content removed: scripts, frames,
+     * embedded objects, event handlers and links or images not pointing
+     * to http(s) or mailto. Meant for Qt rich text labels, which do not
+     * run scripts anyway; this is not a general purpose HTML sanitizer.
+     */
+    QString body;
+
+    /**
+     * Plain text excerpt of the item without any markup, whitespace
+     * collapsed and bounded to a maximum length.
+     */
+    QString summary;
+};
+
+/**
+ * Turns raw item HTML into sanitized HTML and a plain text summary.
+ *
+ * process() does the actual work and may run in a worker thread. Its
+ * results are cached by a fingerprint of the item's text for items the
+ * engine has no earlier text of, e.g. ones shared by several feeds; the
+ * cache itself must only be used from a single thread.
+ */
+class ItemTextProcessor
+{
+public:
+    ItemTextProcessor();
+
+    /**
+     * @return true if the text was processed before, @p text is set then.
+     */
+    bool lookup(const QString &description, const QString &content, ProcessedItemText *text);
+    void insert(const QString &description, const QString &content, const ProcessedItemText &text);
+
+    static ProcessedItemText process(const QString &description, const QString &content);
+
+private:
+    static QByteArray fingerprint(const QString &description, const QString &content);
+    static QString sanitizeHtml(const QString &html);
+
+    /**
+     * @param html Sanitized HTML, it must not refer to local resources.
+     */
+    static QString plainTextSummary(const QString &html);
+
+    QCache<QByteArray, ProcessedItemText> cache;
+};
+
+#endif // ITEMTEXTPROCESSOR_H
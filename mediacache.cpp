@@ -0,0 +1,312 @@
+#include "mediacache.h"
+
+#include "replaycorpus.h"
+
+#include <KSharedConfig>
+#include <KConfigGroup>
+
+#include <QBuffer>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QNetworkRequest>
+#include <QQueue>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtConcurrent>
+
+#define DEFAULT_THUMBNAIL_SIZE 128 // pixels
+#define DEFAULT_CONCURRENT_DOWNLOADS 4
+#define DEFAULT_CACHE_SIZE 51200 // KiB
+#define MAXIMUM_IMAGE_SIZE 0x800000 // 8M
+#define MAXIMUM_IMAGE_PIXELS 16777216 // 4096x4096
+#define FAILURE_RETRY_DELAY 3600000 // 1 hour
+#define LAST_USED_RESOLUTION 3600000 // 1 hour
+
+static bool scaleImage(const QByteArray &data, int size, const QString &localPath)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader ir(&buffer);
+
+    // a small file can still decode to a huge image, refuse those up front
+    const QSize imageSize = ir.size();
+    if (!imageSize.isValid() || qint64(imageSize.width()) * imageSize.height() > MAXIMUM_IMAGE_PIXELS) {
+        return false;
+    }
+
+    // let the decoder scale while reading
+    if (imageSize.width() > size || imageSize.height() > size) {
+        ir.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+    }
+
+    QImage img = ir.read();
+    if (img.isNull()) {
+        return false;
+    }
+
+    if (img.width() > size || img.height() > size) {
+        img = img.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QSaveFile saveFile(localPath);
+    return saveFile.open(QIODevice::WriteOnly) && img.save(&saveFile, "PNG") && saveFile.commit();
+}
+
+struct MediaCache::MediaCachePrivate {
+    struct IndexEntry {
+        qint64 size;
+        qint64 lastUsed;
+    };
+
+    QString storageDir;
+    bool enabled;
+    int thumbnailSize;
+    int maximumDownloads;
+    qint64 maximumCacheSize;
+
+    CorpusNetworkAccessManager nam;
+    QQueue<QUrl> queue;
+    QSet<QUrl> requested;
+    QHash<QUrl, qint64> failed;
+    QHash<QString, QSet<QString>> retained;
+    int activeDownloads = 0;
+
+    QHash<QString, IndexEntry> index;
+    qint64 cacheSize = 0;
+};
+
+MediaCache::MediaCache(QObject *parent)
+    : QObject(parent), d(new MediaCachePrivate)
+{
+    const KConfigGroup config(KSharedConfig::openConfig(QStringLiteral("plasma-dataengine-newsfeedsrc")), "Media");
+    d->enabled = config.readEntry("Prefetch", false);
+    d->thumbnailSize = config.readEntry("ThumbnailSize", DEFAULT_THUMBNAIL_SIZE);
+    d->maximumDownloads = qMax(1, config.readEntry("ConcurrentDownloads", DEFAULT_CONCURRENT_DOWNLOADS));
+    d->maximumCacheSize = config.readEntry("CacheSize", DEFAULT_CACHE_SIZE) * qint64(1024);
+    d->storageDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                    + QStringLiteral("/plasma_engine_newsfeeds/thumbnails/");
+
+    d->nam.setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+    connect(&d->nam, &QNetworkAccessManager::finished,
+            this, &MediaCache::httpFinished);
+#ifndef QT_NO_SSL
+    connect(&d->nam, &QNetworkAccessManager::sslErrors,
+            this, &MediaCache::sslErrors);
+#endif
+
+    if (d->enabled) {
+        loadIndex();
+    }
+}
+
+MediaCache::~MediaCache()
+{
+    delete d;
+}
+
+bool MediaCache::isEnabled() const
+{
+    return d->enabled;
+}
+
+QString MediaCache::thumbnailFile(const QUrl &url)
+{
+    const QString fileName = fileNameForUrl(url);
+    auto it = d->index.find(fileName);
+    if (it == d->index.end()) {
+        return QString();
+    }
+
+    // the index is rebuilt from modification times on startup, keep them
+    // up to date without writing on every lookup
+    const QDateTime now = QDateTime::currentDateTime();
+    if (now.toMSecsSinceEpoch() - it->lastUsed > LAST_USED_RESOLUTION) {
+        QFile file(d->storageDir + fileName);
+        if (file.open(QIODevice::ReadWrite)) {
+            file.setFileTime(now, QFileDevice::FileModificationTime);
+        }
+    }
+
+    it->lastUsed = now.toMSecsSinceEpoch();
+    return d->storageDir + fileName;
+}
+
+bool MediaCache::prefetch(const QUrl &url)
+{
+    if (!d->enabled || !url.isValid()) {
+        return false;
+    }
+
+    // failures are often transient, try again after a while
+    auto failure = d->failed.find(url);
+    if (failure != d->failed.end()) {
+        if (QDateTime::currentMSecsSinceEpoch() - *failure < FAILURE_RETRY_DELAY) {
+            return false;
+        }
+        d->failed.erase(failure);
+    }
+
+    if (!d->requested.contains(url)) {
+        d->requested.insert(url);
+        d->queue.enqueue(url);
+        QMetaObject::invokeMethod(this, "startDownloads", Qt::QueuedConnection);
+    }
+
+    return true;
+}
+
+void MediaCache::retain(const QString &source, const QList<QUrl> &urls)
+{
+    QSet<QString> fileNames;
+    for (const auto& url: urls) {
+        fileNames.insert(fileNameForUrl(url));
+    }
+    d->retained.insert(source, fileNames);
+}
+
+void MediaCache::release(const QString &source)
+{
+    d->retained.remove(source);
+}
+
+void MediaCache::startDownloads()
+{
+    while (d->activeDownloads < d->maximumDownloads && !d->queue.isEmpty()) {
+        const QUrl url = d->queue.dequeue();
+
+        qCDebug(MEDIACACHE) << "downloading" << url;
+        QNetworkRequest request = QNetworkRequest(url);
+        request.setHeader(QNetworkRequest::UserAgentHeader, "KDE Plasma NewsfeedsEngine");
+        request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+
+        QNetworkReply *reply = d->nam.get(request);
+        connect(reply, &QNetworkReply::downloadProgress, reply,
+                [reply](qint64 bytesReceived, qint64 bytesTotal)
+                {
+                    if (bytesReceived > MAXIMUM_IMAGE_SIZE || bytesTotal > MAXIMUM_IMAGE_SIZE) {
+                        qCWarning(MEDIACACHE) << "Image too big, aborting download of" << reply->request().url();
+                        reply->abort();
+                    }
+                });
+        ++d->activeDownloads;
+    }
+}
+
+void MediaCache::httpFinished(QNetworkReply *reply)
+{
+    reply->deleteLater();
+    --d->activeDownloads;
+    startDownloads();
+
+    const QUrl url = reply->request().url();
+    const QByteArray data = reply->readAll();
+    ReplayCorpus::instance()->record(url, reply, data);
+
+    if (reply->error()) {
+        qCDebug(MEDIACACHE) << "Error during download of" << url << "." << "Error:" << reply->error();
+        d->requested.remove(url);
+        d->failed.insert(url, QDateTime::currentMSecsSinceEpoch());
+        emit thumbnailReady(url, QString());
+        return;
+    }
+
+    ensureStorageExists();
+    const QString fileName = fileNameForUrl(url);
+    const QString localPath = d->storageDir + fileName;
+
+    auto *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this,
+            [this, watcher, url, fileName, localPath]()
+            {
+                watcher->deleteLater();
+                d->requested.remove(url);
+
+                if (!watcher->result()) {
+                    qCDebug(MEDIACACHE) << "Couldn't create thumbnail of" << url;
+                    d->failed.insert(url, QDateTime::currentMSecsSinceEpoch());
+                    emit thumbnailReady(url, QString());
+                    return;
+                }
+
+                insertIntoIndex(fileName);
+                emit thumbnailReady(url, localPath);
+            });
+    watcher->setFuture(QtConcurrent::run(scaleImage, data, d->thumbnailSize, localPath));
+}
+
+void MediaCache::loadIndex()
+{
+    const QFileInfoList files = QDir(d->storageDir).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    for (const auto& file: files) {
+        d->index.insert(file.fileName(), {file.size(), file.lastModified().toMSecsSinceEpoch()});
+        d->cacheSize += file.size();
+    }
+}
+
+void MediaCache::insertIntoIndex(const QString &fileName)
+{
+    const qint64 size = QFileInfo(d->storageDir + fileName).size();
+    const auto previous = d->index.value(fileName, {0, 0});
+    d->cacheSize += size - previous.size;
+    d->index.insert(fileName, {size, QDateTime::currentMSecsSinceEpoch()});
+
+    while (d->cacheSize > d->maximumCacheSize) {
+        // thumbnails items currently show are kept
+        auto oldest = d->index.end();
+        for (auto it = d->index.begin(); it != d->index.end(); ++it) {
+            if ((oldest == d->index.end() || it->lastUsed < oldest->lastUsed) && !isRetained(it.key())) {
+                oldest = it;
+            }
+        }
+
+        if (oldest == d->index.end()) {
+            qCDebug(MEDIACACHE) << "Cache size exceeded by thumbnails in use:" << d->cacheSize << "bytes";
+            break;
+        }
+
+        qCDebug(MEDIACACHE) << "Removing thumbnail" << oldest.key();
+        QFile::remove(d->storageDir + oldest.key());
+        d->cacheSize -= oldest->size;
+        d->index.erase(oldest);
+    }
+}
+
+bool MediaCache::isRetained(const QString &fileName) const
+{
+    for (const auto& fileNames: d->retained) {
+        if (fileNames.contains(fileName)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString MediaCache::fileNameForUrl(const QUrl &url) const
+{
+    const QByteArray hash = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+    return QString::fromLatin1(hash) + QLatin1Char('_') + QString::number(d->thumbnailSize) + QLatin1String(".png");
+}
+
+void MediaCache::ensureStorageExists()
+{
+    QDir().mkpath(d->storageDir);
+}
+
+#ifndef QT_NO_SSL
+void MediaCache::sslErrors(QNetworkReply *, const QList<QSslError> &errors)
+{
+  qCCritical(MEDIACACHE) << "SSL errors:" << errors;
+}
+#endif
+
+Q_LOGGING_CATEGORY(MEDIACACHE, "mediacache")
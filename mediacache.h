@@ -0,0 +1,82 @@
+#ifndef MEDIACACHE_H
+#define MEDIACACHE_H
+
+#include <QObject>
+#include <QUrl>
+#include <QString>
+#include <QNetworkReply>
+#include <QList>
+#include <QSslError>
+#include <QLoggingCategory>
+
+/**
+ * Downloads item images and keeps thumbnails of them on disk.
+ *
+ * At most a few downloads run at the same time, the rest waits in a queue.
+ * Images are decoded and scaled down in a worker thread. The cache has
+ * a maximum size on disk; an in-memory index of the cached files evicts
+ * the least recently used thumbnails when it is exceeded. The time a
+ * thumbnail was last used is kept as its modification time.
+ */
+class MediaCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    MediaCache(QObject *parent = nullptr);
+    ~MediaCache();
+
+    /**
+     * @return true if prefetching is enabled in the configuration.
+     */
+    bool isEnabled() const;
+
+    /**
+     * @return The path of the cached thumbnail for the given URL or an
+     * empty string if it is not cached yet.
+     */
+    QString thumbnailFile(const QUrl &url);
+
+    /**
+     * Queues the download of the given image. thumbnailReady() is emitted
+     * once it is done.
+     * @return false if the image will not be downloaded, because it
+     * failed recently or prefetching is disabled.
+     */
+    bool prefetch(const QUrl &url);
+
+    /**
+     * Sets the images the items of @p source show. Their thumbnails are
+     * not removed from the cache while the source references them.
+     */
+    void retain(const QString &source, const QList<QUrl> &urls);
+    void release(const QString &source);
+
+Q_SIGNALS:
+    /**
+     * @param file The path of the thumbnail, empty if the image could
+     * not be downloaded or decoded.
+     */
+    void thumbnailReady(const QUrl &url, const QString &file);
+
+private Q_SLOTS:
+    void startDownloads();
+    void httpFinished(QNetworkReply *reply);
+#ifndef QT_NO_SSL
+    void sslErrors(QNetworkReply *, const QList<QSslError> &errors);
+#endif
+
+private:
+    struct MediaCachePrivate;
+    MediaCachePrivate *const d;
+
+    void loadIndex();
+    void insertIntoIndex(const QString &fileName);
+    bool isRetained(const QString &fileName) const;
+    void ensureStorageExists();
+    QString fileNameForUrl(const QUrl &url) const;
+};
+
+Q_DECLARE_LOGGING_CATEGORY(MEDIACACHE)
+
+#endif // MEDIACACHE_H
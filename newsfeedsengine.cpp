@@ -1,18 +1,38 @@
 #include "newsfeedsengine.h"
 
 #include "fileretriever.h"
+#include "newsfeedsservice.h"
+#include "replaycorpus.h"
 
 #include <Syndication/Image>
 #include <Syndication/DataRetriever>
 
+#include <Plasma/DataContainer>
+
 #include <KLocalizedString>
+#include <KSharedConfig>
+#include <KConfigGroup>
 
 #include <QUrl>
 #include <QString>
 #include <QVariant>
 #include <QMap>
+#include <QStringList>
+#include <QDateTime>
+#include <QDomElement>
+#include <QFutureWatcher>
+#include <QPair>
+#include <QVector>
+#include <QtConcurrent>
+
+#include <algorithm>
 
 #define MINIMUM_INTERVAL 5000 // 5 seconds
+#define DEFAULT_MEMORY_BUDGET 16384 // KiB
+#define DEFAULT_IDLE_TIMEOUT 600 // 10 minutes
+#define DEFAULT_FRESHNESS_THRESHOLD 300 // 5 minutes
+#define READ_STATE_SAVE_DELAY 5000 // 5 seconds
+#define PAYLOAD_SAVE_DELAY 5000 // 5 seconds
 
 NewsFeedsEngine::NewsFeedsEngine(QObject* parent, const QVariantList& args)
     : Plasma::DataEngine(parent, args), networkConfigurationManager(this)
@@ -24,13 +44,131 @@ NewsFeedsEngine::NewsFeedsEngine(QObject* parent, const QVariantList& args)
     // update interval and using too much CPU.
     setMinimumPollingInterval(MINIMUM_INTERVAL);
 
-    connect(&networkConfigurationManager, &QNetworkConfigurationManager::onlineStateChanged,
-            this, &NewsFeedsEngine::networkStatusChanged);
+    // A budget of 0 disables eviction of item bodies.
+    const KConfigGroup config(KSharedConfig::openConfig(QStringLiteral("plasma-dataengine-newsfeedsrc")), "General");
+    memoryBudget = config.readEntry("MemoryBudget", DEFAULT_MEMORY_BUDGET) * qint64(1024);
+    idleTimeout = std::chrono::seconds(config.readEntry("IdleTimeout", DEFAULT_IDLE_TIMEOUT));
+    freshnessThreshold = std::chrono::seconds(config.readEntry("FreshnessThreshold", DEFAULT_FRESHNESS_THRESHOLD));
+
+    // updates triggered by the network state would make replays nondeterministic
+    if (ReplayCorpus::instance()->mode() != ReplayCorpus::Replay) {
+        connect(&networkConfigurationManager, &QNetworkConfigurationManager::onlineStateChanged,
+                this, &NewsFeedsEngine::networkStatusChanged);
+    }
+    connect(this, &Plasma::DataEngine::sourceRemoved,
+            this, &NewsFeedsEngine::sourceWasRemoved);
+
+    // batch consecutive changes of the read state into a single write
+    readState.load();
+    readStateSaveTimer.setSingleShot(true);
+    readStateSaveTimer.setInterval(READ_STATE_SAVE_DELAY);
+    connect(&readStateSaveTimer, &QTimer::timeout,
+            this, &NewsFeedsEngine::saveReadState);
+
+    // copies of the sources are written one after another, off the thread
+    // plasmashell draws in
+    payloadStorePool.setMaxThreadCount(1);
+    const PayloadStore store = payloadStore;
+    QtConcurrent::run(&payloadStorePool, [store]() mutable
+            {
+                store.prune();
+            });
+
+    // the feed and its icon arrive separately, save both in one write
+    payloadSaveTimer.setSingleShot(true);
+    payloadSaveTimer.setInterval(PAYLOAD_SAVE_DELAY);
+    connect(&payloadSaveTimer, &QTimer::timeout,
+            this, &NewsFeedsEngine::savePayloads);
+
+    connect(&mediaCache, &MediaCache::thumbnailReady,
+            this, &NewsFeedsEngine::thumbnailReady);
 }
 
 NewsFeedsEngine::~NewsFeedsEngine()
 {
     qCDebug(NEWSFEEDSENGINE) << "~NewsFeedsEngine";
+
+    if (readState.hasUnsavedChanges()) {
+        saveReadState();
+    }
+    savePayloads();
+    payloadStorePool.waitForDone();
+}
+
+Plasma::Service *NewsFeedsEngine::serviceForSource(const QString &source)
+{
+    return new NewsFeedsService(this, source);
+}
+
+bool NewsFeedsEngine::markItemRead(const QString &source, const QString &itemId)
+{
+    qCDebug(NEWSFEEDSENGINE) << "NewsFeedsEngine::markItemRead(source =" << source << ", itemId =" << itemId << ")";
+
+    const Plasma::DataContainer *container = containerForSource(source);
+    if (container == nullptr || itemId.isEmpty()) {
+        return false;
+    }
+
+    touchSource(source);
+
+    if (!readState.markRead(source, itemId)) {
+        return true;
+    }
+    readStateSaveTimer.start();
+
+    QVariantList items = container->data().value(QStringLiteral("Items")).toList();
+    for (auto& item: items) {
+        QVariantMap itemData = item.toMap();
+        if (itemKey(itemData) != itemId) {
+            continue;
+        }
+
+        if (!itemData.value(QStringLiteral("Read")).toBool()) {
+            itemData[QStringLiteral("Read")] = true;
+            item = itemData;
+
+            const int unreadCount = container->data().value(QStringLiteral("UnreadCount")).toInt();
+            setData(source, QStringLiteral("Items"), items);
+            setData(source, QStringLiteral("UnreadCount"), std::max(0, unreadCount - 1));
+        }
+        break;
+    }
+
+    return true;
+}
+
+bool NewsFeedsEngine::markAllItemsRead(const QString &source)
+{
+    qCDebug(NEWSFEEDSENGINE) << "NewsFeedsEngine::markAllItemsRead(source =" << source << ")";
+
+    const Plasma::DataContainer *container = containerForSource(source);
+    if (container == nullptr) {
+        return false;
+    }
+
+    touchSource(source);
+
+    QVariantList items = container->data().value(QStringLiteral("Items")).toList();
+    bool changed = false;
+    for (auto& item: items) {
+        QVariantMap itemData = item.toMap();
+        if (itemData.value(QStringLiteral("Read")).toBool()) {
+            continue;
+        }
+
+        readState.markRead(source, itemKey(itemData));
+        itemData[QStringLiteral("Read")] = true;
+        item = itemData;
+        changed = true;
+    }
+
+    if (changed) {
+        readStateSaveTimer.start();
+        setData(source, QStringLiteral("Items"), items);
+    }
+    setData(source, QStringLiteral("UnreadCount"), 0);
+
+    return true;
 }
 
 bool NewsFeedsEngine::sourceRequestEvent(const QString &source)
@@ -38,17 +176,26 @@ bool NewsFeedsEngine::sourceRequestEvent(const QString &source)
     qCDebug(NEWSFEEDSENGINE) << "NewsFeedsEngine::sourceRequestEvent(source =" << source << ")";
 
     setData(source, Data());
-
-    Syndication::Loader * loader = loadingNews.take(source);
-    if (loader != nullptr) {
-      loader->abort();
+    sourceUsage.insert(source, SourceUsage());
+
+    // serve the data kept from an earlier request right away and fetch the
+    // feed again only if it was fetched longer ago than the freshness threshold
+    qint64 fetchedAt = 0;
+    const bool restored = restoreSource(source, &fetchedAt);
+    const bool fresh = restored && fetchedAt > 0
+        && std::chrono::milliseconds(QDateTime::currentMSecsSinceEpoch() - fetchedAt) < freshnessThreshold;
+
+    if (fresh) {
+        qCDebug(NEWSFEEDSENGINE) << "Source" << source << "is fresh";
+        return true;
     }
 
-    FaviconRequestJob *job = loadingIcons.take(source);
-    if (job != nullptr) {
-      job->abort();
+    if (restored) {
+        setData(source, QStringLiteral("Stale"), true);
     }
 
+    // fetches still in flight from an earlier request are joined, their
+    // results land in this source
     updateSourceEvent(source);
 
     return true;
@@ -58,12 +205,25 @@ bool NewsFeedsEngine::updateSourceEvent(const QString &source)
 {
     qCDebug(NEWSFEEDSENGINE) << "NewsFeedsEngine::updateSourceEvent(source =" << source << ")";
 
-    if (loadingNews.contains(source) || loadingIcons.contains(source)) {
+    if (loadingNews.contains(source) && loadingIcons.contains(source)) {
         qCDebug(NEWSFEEDSENGINE) << "Source" << source << "still loading";
         return false;
     }
 
-    // load news
+    // only start what is not in flight already, a running fetch is joined;
+    // an evicted source gets its item bodies back from the fetch
+    if (!loadingNews.contains(source)) {
+        loadNews(source);
+    }
+    if (!loadingIcons.contains(source)) {
+        loadIcon(source);
+    }
+
+    return false;
+}
+
+void NewsFeedsEngine::loadNews(const QString &source)
+{
     qCDebug(NEWSFEEDSENGINE) << "Loading news for source" << source;
 
     Syndication::Loader *loader = Syndication::Loader::create();
@@ -73,9 +233,18 @@ bool NewsFeedsEngine::updateSourceEvent(const QString &source)
             {
                 feedReady(std::move(source), l, std::move(fp), std::move(ec));
             });
-    loader->loadFrom(QUrl(source), new FileRetriever);
+    FileRetriever *retriever = new FileRetriever;
+    connect(retriever, &FileRetriever::redirectsResolved, this,
+            [this, source](const QUrl &effectiveUrl, int redirectCount)
+            {
+                setData(source, QStringLiteral("EffectiveUrl"), effectiveUrl.toString());
+                setData(source, QStringLiteral("RedirectCount"), redirectCount);
+            });
+    loader->loadFrom(QUrl(source), retriever);
+}
 
-    //load icon
+void NewsFeedsEngine::loadIcon(const QString &source)
+{
     qCDebug(NEWSFEEDSENGINE) << "Loading icon for source" << source;
 
     FaviconRequestJob *job = new FaviconRequestJob(QUrl(source));
@@ -85,15 +254,19 @@ bool NewsFeedsEngine::updateSourceEvent(const QString &source)
             {
                 iconReady(std::move(source), job);
             });
-
-    return false;
 }
 
 void NewsFeedsEngine::feedReady(QString source, Syndication::Loader* /*loader*/, Syndication::FeedPtr feed, Syndication::ErrorCode errorCode)
 {
     qCDebug(NEWSFEEDSENGINE) << "NewsFeedsEngine::feedReady(source =" << source << ")";
 
-    if (errorCode != Syndication::Success) {
+    const Plasma::DataContainer *container = containerForSource(source);
+    const bool stale = container != nullptr && container->data().value(QStringLiteral("Stale")).toBool();
+
+    if (errorCode != Syndication::Success && stale) {
+        // keep serving the stale data, the next update tries again
+        qCDebug(NEWSFEEDSENGINE) << "Revalidating feed" << source << "failed, keeping stale data." << "Error:" << errorCode;
+    } else if (errorCode != Syndication::Success) {
         qCDebug(NEWSFEEDSENGINE) << "Fetching feed" << source << "failed." << "Error:" << errorCode;
         setData(source, QStringLiteral("Title"),       i18n("Fetching feed failed."));
         setData(source, QStringLiteral("Link"),        source);
@@ -103,6 +276,10 @@ void NewsFeedsEngine::feedReady(QString source, Syndication::Loader* /*loader*/,
         removeData(source, QStringLiteral("Authors"));
         removeData(source, QStringLiteral("Categories"));
         removeData(source, QStringLiteral("Items"));
+        removeData(source, QStringLiteral("UnreadCount"));
+        removeData(source, QStringLiteral("FetchedAt"));
+        removeData(source, QStringLiteral("Evicted"));
+        sourceUsage[source].evicted = false;
     } else {
         setData(source, QStringLiteral("Title"),       feed->title());
         setData(source, QStringLiteral("Link"),        feed->link());
@@ -111,10 +288,15 @@ void NewsFeedsEngine::feedReady(QString source, Syndication::Loader* /*loader*/,
         setData(source, QStringLiteral("Copyright"),   feed->copyright());
         setData(source, QStringLiteral("Authors"),     getAuthors(feed->authors()));
         setData(source, QStringLiteral("Categories"),  getCategories(feed->categories()));
-        setData(source, QStringLiteral("Items"),       getItems(feed->items()));
+
+        // the items are published once their text is processed
+        applyItemText(source, getItems(feed->items()));
     }
 
     loadingNews.remove(source);
+
+    updateResidentBytes(source);
+    enforceMemoryBudget(source);
 }
 
 void NewsFeedsEngine::iconReady(QString source, FaviconRequestJob* job)
@@ -128,11 +310,417 @@ void NewsFeedsEngine::iconReady(QString source, FaviconRequestJob* job)
     } else {
         iconFile = job->iconFile();
         setData(source, QStringLiteral("Image"), iconFile);
+
+        schedulePayloadSave(source);
     }
 
+    setData(source, QStringLiteral("ImageEffectiveUrl"), job->effectiveUrl().toString());
+    setData(source, QStringLiteral("ImageRedirectCount"), job->redirectCount());
+
     loadingIcons.remove(source);
 }
 
+void NewsFeedsEngine::sourceWasRemoved(const QString &source)
+{
+    // the compact copy of the data stays on disk for the next request
+    sourceUsage.remove(source);
+    processingItems.remove(source);
+    mediaCache.release(source);
+}
+
+void NewsFeedsEngine::touchSource(const QString &source)
+{
+    // only requests and service operations count as reading a source, polls
+    // keep coming while nobody looks at it
+    SourceUsage &usage = sourceUsage[source];
+    usage.lastAccess = std::chrono::steady_clock::now();
+
+    // a source in use again gets its item bodies back
+    if (usage.evicted) {
+        restoreSource(source);
+    }
+}
+
+void NewsFeedsEngine::updateResidentBytes(const QString &source)
+{
+    const Plasma::DataContainer *container = containerForSource(source);
+    if (container == nullptr) {
+        return;
+    }
+
+    qint64 residentBytes = 0;
+    const Data data = container->data();
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if (it.key() != QLatin1String("ResidentBytes")) {
+            residentBytes += it.key().size() * sizeof(QChar) + PayloadStore::estimateSize(it.value());
+        }
+    }
+
+    SourceUsage &usage = sourceUsage[source];
+    if (usage.residentBytes != residentBytes) {
+        usage.residentBytes = residentBytes;
+        setData(source, QStringLiteral("ResidentBytes"), residentBytes);
+    }
+}
+
+void NewsFeedsEngine::enforceMemoryBudget(const QString &keptSource)
+{
+    if (memoryBudget <= 0) {
+        return;
+    }
+
+    qint64 totalBytes = 0;
+    for (const auto& usage: sourceUsage) {
+        totalBytes += usage.residentBytes;
+    }
+
+    if (totalBytes <= memoryBudget) {
+        return;
+    }
+
+    // sources nobody is connected to or nobody asked for in a while are
+    // evicted first, least recently used first
+    const auto now = std::chrono::steady_clock::now();
+    QStringList candidates;
+    for (auto it = sourceUsage.constBegin(); it != sourceUsage.constEnd(); ++it) {
+        if (it->evicted || it.key() == keptSource || loadingNews.contains(it.key())) {
+            continue;
+        }
+
+        const Plasma::DataContainer *container = containerForSource(it.key());
+        if (container == nullptr || !container->isUsed() || now - it->lastAccess > idleTimeout) {
+            candidates.append(it.key());
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(),
+              [this](const QString &a, const QString &b)
+              {
+                  return sourceUsage.value(a).lastAccess < sourceUsage.value(b).lastAccess;
+              });
+
+    for (const auto& source: candidates) {
+        if (totalBytes <= memoryBudget) {
+            break;
+        }
+
+        const qint64 before = sourceUsage.value(source).residentBytes;
+        evictSource(source);
+        totalBytes -= before - sourceUsage.value(source).residentBytes;
+    }
+
+    if (totalBytes > memoryBudget) {
+        qCDebug(NEWSFEEDSENGINE) << "Memory budget of" << memoryBudget << "bytes exceeded by recently used sources:" << totalBytes << "bytes";
+    }
+}
+
+void NewsFeedsEngine::evictSource(const QString &source)
+{
+    const Plasma::DataContainer *container = containerForSource(source);
+    if (container == nullptr) {
+        return;
+    }
+
+    qCDebug(NEWSFEEDSENGINE) << "Evicting item bodies of source" << source;
+
+    // the copy on disk has to be complete before the bodies are dropped
+    if (unsavedPayloads.contains(source)) {
+        savePayload(source, unsavedPayloads.take(source));
+    }
+
+    QVariantList items = container->data().value(QStringLiteral("Items")).toList();
+    for (auto& item: items) {
+        QVariantMap itemData = item.toMap();
+        itemData.remove(QStringLiteral("Description"));
+        itemData.remove(QStringLiteral("Content"));
+        itemData.remove(QStringLiteral("Body"));
+        item = itemData;
+    }
+
+    setData(source, QStringLiteral("Items"), items);
+    setData(source, QStringLiteral("Evicted"), true);
+    sourceUsage[source].evicted = true;
+
+    updateResidentBytes(source);
+}
+
+bool NewsFeedsEngine::restoreSource(const QString &source, qint64 *fetchedAt)
+{
+    if (unsavedPayloads.contains(source)) {
+        savePayload(source, unsavedPayloads.take(source));
+    }
+
+    // the copy may still be being written
+    payloadStorePool.waitForDone();
+
+    QVariantHash data;
+    if (!payloadStore.loadData(source, &data)) {
+        return false;
+    }
+
+    if (fetchedAt != nullptr) {
+        *fetchedAt = data.value(QStringLiteral("FetchedAt")).toLongLong();
+    }
+
+    qCDebug(NEWSFEEDSENGINE) << "Restoring source" << source << "from disk";
+
+    QVariantList items = data.take(QStringLiteral("Items")).toList();
+    const int unreadCount = applyReadState(source, items);
+    applyThumbnails(source, items);
+
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        setData(source, it.key(), it.value());
+    }
+    setData(source, QStringLiteral("Items"), items);
+    setData(source, QStringLiteral("UnreadCount"), unreadCount);
+    removeData(source, QStringLiteral("Evicted"));
+    sourceUsage[source].evicted = false;
+
+    updateResidentBytes(source);
+    enforceMemoryBudget(source);
+
+    return true;
+}
+
+void NewsFeedsEngine::saveReadState()
+{
+    readState.save();
+}
+
+void NewsFeedsEngine::savePayloads()
+{
+    payloadSaveTimer.stop();
+
+    for (auto it = unsavedPayloads.constBegin(); it != unsavedPayloads.constEnd(); ++it) {
+        savePayload(it.key(), it.value());
+    }
+    unsavedPayloads.clear();
+}
+
+void NewsFeedsEngine::schedulePayloadSave(const QString &source)
+{
+    // a snapshot is kept, the source may be gone by the time it is saved;
+    // only data of a fetched feed is kept, with the time it was fetched
+    const Plasma::DataContainer *container = containerForSource(source);
+    if (container == nullptr || sourceUsage.value(source).evicted
+        || !container->data().contains(QStringLiteral("FetchedAt"))) {
+        return;
+    }
+
+    unsavedPayloads.insert(source, container->data());
+    if (!payloadSaveTimer.isActive()) {
+        payloadSaveTimer.start();
+    }
+}
+
+void NewsFeedsEngine::savePayload(const QString &source, Data data)
+{
+    // values describing the state of the engine are recomputed on restore
+    data.remove(QStringLiteral("ResidentBytes"));
+    data.remove(QStringLiteral("Evicted"));
+    data.remove(QStringLiteral("Stale"));
+    data.remove(QStringLiteral("UnreadCount"));
+
+    // serializing and compressing the items is expensive
+    const PayloadStore store = payloadStore;
+    QtConcurrent::run(&payloadStorePool, [store, source, data]() mutable
+            {
+                store.saveData(source, data);
+            });
+}
+
+int NewsFeedsEngine::applyReadState(const QString &source, QVariantList &items)
+{
+    int unreadCount = 0;
+    for (auto& item: items) {
+        QVariantMap itemData = item.toMap();
+        const bool read = readState.isRead(source, itemKey(itemData));
+        itemData[QStringLiteral("Read")] = read;
+        item = itemData;
+
+        if (!read) {
+            ++unreadCount;
+        }
+    }
+
+    // timestamps of read items still in the feed were refreshed
+    if (readState.hasUnsavedChanges() && !readStateSaveTimer.isActive()) {
+        readStateSaveTimer.start();
+    }
+
+    return unreadCount;
+}
+
+QString NewsFeedsEngine::itemKey(const QVariantMap &itemData)
+{
+    const QString id = itemData.value(QStringLiteral("Id")).toString();
+    return id.isEmpty() ? itemData.value(QStringLiteral("Link")).toString() : id;
+}
+
+void NewsFeedsEngine::applyItemText(const QString &source, QVariantList items)
+{
+    // items which did not change since the last update keep their text
+    QHash<QString, QVariantMap> previousItems;
+    const Plasma::DataContainer *container = containerForSource(source);
+    if (container != nullptr) {
+        for (const auto& item: container->data().value(QStringLiteral("Items")).toList()) {
+            const QVariantMap itemData = item.toMap();
+            if (itemData.contains(QStringLiteral("Body"))) {
+                previousItems.insert(itemKey(itemData), itemData);
+            }
+        }
+    }
+
+    QVector<int> pending;
+    QVector<QPair<QString, QString>> pendingText;
+    for (int i = 0; i < items.size(); ++i) {
+        QVariantMap itemData = items.at(i).toMap();
+        const QString description = itemData.value(QStringLiteral("Description")).toString();
+        const QString content = itemData.value(QStringLiteral("Content")).toString();
+
+        ProcessedItemText text;
+        const QVariantMap previous = previousItems.value(itemKey(itemData));
+        if (!previous.isEmpty()
+            && previous.value(QStringLiteral("Description")).toString() == description
+            && previous.value(QStringLiteral("Content")).toString() == content) {
+            text.body = previous.value(QStringLiteral("Body")).toString();
+            text.summary = previous.value(QStringLiteral("Summary")).toString();
+        } else if (!textProcessor.lookup(description, content, &text)) {
+            pending.append(i);
+            pendingText.append(qMakePair(description, content));
+            continue;
+        }
+
+        itemData[QStringLiteral("Body")] = text.body;
+        itemData[QStringLiteral("Summary")] = text.summary;
+        items[i] = itemData;
+    }
+
+    // a newer update of the source replaces items still being processed
+    processingItems.remove(source);
+
+    if (pending.isEmpty()) {
+        publishItems(source, items);
+        return;
+    }
+
+    // parsing HTML is expensive, keep it off the thread plasmashell draws in
+    auto *watcher = new QFutureWatcher<QVector<ProcessedItemText>>(this);
+    processingItems.insert(source, watcher);
+    connect(watcher, &QFutureWatcher<QVector<ProcessedItemText>>::finished, this,
+            [this, watcher, source, items, pending, pendingText]() mutable
+            {
+                watcher->deleteLater();
+
+                const QVector<ProcessedItemText> texts = watcher->result();
+                for (int i = 0; i < texts.size(); ++i) {
+                    textProcessor.insert(pendingText.at(i).first, pendingText.at(i).second, texts.at(i));
+
+                    QVariantMap itemData = items.at(pending.at(i)).toMap();
+                    itemData[QStringLiteral("Body")] = texts.at(i).body;
+                    itemData[QStringLiteral("Summary")] = texts.at(i).summary;
+                    items[pending.at(i)] = itemData;
+                }
+
+                // the source may have been removed or updated again meanwhile
+                if (processingItems.value(source) != watcher) {
+                    return;
+                }
+                processingItems.remove(source);
+
+                if (containerForSource(source) != nullptr) {
+                    publishItems(source, items);
+                    updateResidentBytes(source);
+                    enforceMemoryBudget(source);
+                }
+            });
+    watcher->setFuture(QtConcurrent::run([pendingText]()
+            {
+                QVector<ProcessedItemText> texts;
+                texts.reserve(pendingText.size());
+                for (const auto& text: pendingText) {
+                    texts.append(ItemTextProcessor::process(text.first, text.second));
+                }
+                return texts;
+            }));
+}
+
+void NewsFeedsEngine::publishItems(const QString &source, QVariantList items)
+{
+    const int unreadCount = applyReadState(source, items);
+    applyThumbnails(source, items);
+    setData(source, QStringLiteral("Items"),       items);
+    setData(source, QStringLiteral("UnreadCount"), unreadCount);
+    setData(source, QStringLiteral("FetchedAt"),   QDateTime::currentMSecsSinceEpoch());
+    removeData(source, QStringLiteral("Evicted"));
+    removeData(source, QStringLiteral("Stale"));
+    sourceUsage[source].evicted = false;
+
+    schedulePayloadSave(source);
+}
+
+void NewsFeedsEngine::applyThumbnails(const QString &source, QVariantList &items)
+{
+    if (!mediaCache.isEnabled()) {
+        return;
+    }
+
+    QList<QUrl> thumbnailUrls;
+    for (auto& item: items) {
+        QVariantMap itemData = item.toMap();
+        const QUrl thumbnailUrl(itemData.value(QStringLiteral("ThumbnailUrl")).toString());
+        if (thumbnailUrl.isEmpty()) {
+            continue;
+        }
+        thumbnailUrls.append(thumbnailUrl);
+
+        // restored items may refer to a thumbnail removed from the cache since
+        const QString thumbnailFile = mediaCache.thumbnailFile(thumbnailUrl);
+        if (!thumbnailFile.isEmpty()) {
+            itemData[QStringLiteral("ThumbnailFile")] = thumbnailFile;
+        } else {
+            itemData.remove(QStringLiteral("ThumbnailFile"));
+            if (mediaCache.prefetch(thumbnailUrl)) {
+                loadingThumbnails[thumbnailUrl].insert(source);
+            }
+        }
+        item = itemData;
+    }
+
+    mediaCache.retain(source, thumbnailUrls);
+}
+
+void NewsFeedsEngine::thumbnailReady(const QUrl &url, const QString &file)
+{
+    const QSet<QString> thumbnailSources = loadingThumbnails.take(url);
+    if (file.isEmpty()) {
+        return;
+    }
+
+    for (const auto& source: thumbnailSources) {
+        const Plasma::DataContainer *container = containerForSource(source);
+        if (container == nullptr) {
+            continue;
+        }
+
+        // compare parsed URLs, the string in the item is not normalized
+        QVariantList items = container->data().value(QStringLiteral("Items")).toList();
+        bool changed = false;
+        for (auto& item: items) {
+            QVariantMap itemData = item.toMap();
+            if (QUrl(itemData.value(QStringLiteral("ThumbnailUrl")).toString()) == url) {
+                itemData[QStringLiteral("ThumbnailFile")] = file;
+                item = itemData;
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            setData(source, QStringLiteral("Items"), items);
+        }
+    }
+}
+
 QVariantList NewsFeedsEngine::getAuthors(QList<Syndication::PersonPtr> authors)
 {
     QVariantList authorsData;
@@ -195,6 +783,23 @@ QVariantList NewsFeedsEngine::getEnclosures(QList<Syndication::EnclosurePtr> enc
     return enclosuresData;
 }
 
+QString NewsFeedsEngine::getThumbnailUrl(Syndication::ItemPtr item)
+{
+    // Media RSS thumbnail, keyed by namespace URI and local name
+    const QDomElement thumbnail = item->additionalProperties().value(QStringLiteral("http://search.yahoo.com/mrss/thumbnail"));
+    if (!thumbnail.isNull() && !thumbnail.attribute(QStringLiteral("url")).isEmpty()) {
+        return thumbnail.attribute(QStringLiteral("url"));
+    }
+
+    for (const auto& enclosure: item->enclosures()) {
+        if (!enclosure->isNull() && enclosure->type().startsWith(QLatin1String("image/"))) {
+            return enclosure->url();
+        }
+    }
+
+    return QString();
+}
+
 QVariantList NewsFeedsEngine::getItems(QList<Syndication::ItemPtr> items)
 {
     QVariantList itemsData;
@@ -221,6 +826,7 @@ QVariantList NewsFeedsEngine::getItems(QList<Syndication::ItemPtr> items)
         itemData[QStringLiteral("Authors")] = getAuthors(item->authors());
         itemData[QStringLiteral("Enclosures")] = getEnclosures(item->enclosures());
         itemData[QStringLiteral("Categories")] = getCategories(item->categories());
+        itemData[QStringLiteral("ThumbnailUrl")] = getThumbnailUrl(item);
 
         itemsData.append(itemData);
     }
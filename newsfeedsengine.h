@@ -4,6 +4,10 @@
 #define NEWSFEEDSENGINE_H
 
 #include "faviconrequestjob.h"
+#include "itemtextprocessor.h"
+#include "mediacache.h"
+#include "payloadstore.h"
+#include "readstatestore.h"
 
 #include <Plasma/DataEngine>
 
@@ -21,6 +25,7 @@
 #include <QSet>
 #include <QHash>
 #include <QLoggingCategory>
+#include <QThreadPool>
 #include <QTimer>
 
 #include <chrono>
@@ -37,6 +42,15 @@ public:
     NewsFeedsEngine(QObject* parent, const QVariantList &args);
     ~NewsFeedsEngine();
 
+    Plasma::Service *serviceForSource(const QString &source) override;
+
+    /**
+     * Marks the item with the given id (or link if it has no id) read.
+     * @return false if the source does not exist.
+     */
+    bool markItemRead(const QString &source, const QString &itemId);
+    bool markAllItemsRead(const QString &source);
+
 protected:
 // this virtual function is called when a new source is requested
     bool sourceRequestEvent(const QString& source) override;
@@ -54,16 +68,56 @@ private Q_SLOTS:
                    Syndication::FeedPtr feed,
                    Syndication::ErrorCode errorCode);
     void iconReady(QString source, FaviconRequestJob* job);
+    void sourceWasRemoved(const QString &source);
+    void saveReadState();
+    void savePayloads();
+    void thumbnailReady(const QUrl &url, const QString &file);
 
 private:
+    struct SourceUsage {
+        qint64 residentBytes = 0;
+        std::chrono::steady_clock::time_point lastAccess = std::chrono::steady_clock::now();
+        bool evicted = false;
+    };
+
     QHash<QString, Syndication::Loader*> loadingNews;
     QHash<QString, FaviconRequestJob*> loadingIcons;
+    QHash<QString, SourceUsage> sourceUsage;
+    QHash<QUrl, QSet<QString>> loadingThumbnails;
+    QHash<QString, Data> unsavedPayloads;
+    QHash<QString, QObject*> processingItems;
     QNetworkConfigurationManager networkConfigurationManager;
+    ItemTextProcessor textProcessor;
+    PayloadStore payloadStore;
+    QThreadPool payloadStorePool;
+    QTimer payloadSaveTimer;
+    ReadStateStore readState;
+    QTimer readStateSaveTimer;
+    MediaCache mediaCache;
+    qint64 memoryBudget;
+    std::chrono::seconds idleTimeout;
+    std::chrono::seconds freshnessThreshold;
+
+    void loadNews(const QString &source);
+    void loadIcon(const QString &source);
+    void touchSource(const QString &source);
+    void updateResidentBytes(const QString &source);
+    void enforceMemoryBudget(const QString &keptSource = QString());
+    void evictSource(const QString &source);
+    bool restoreSource(const QString &source, qint64 *fetchedAt = nullptr);
+    void schedulePayloadSave(const QString &source);
+    void savePayload(const QString &source, Data data);
+    int applyReadState(const QString &source, QVariantList &items);
+    static QString itemKey(const QVariantMap &itemData);
+    void applyItemText(const QString &source, QVariantList items);
+    void publishItems(const QString &source, QVariantList items);
+    void applyThumbnails(const QString &source, QVariantList &items);
 
     QVariantList getAuthors(QList<Syndication::PersonPtr> authors);
     QVariantList getCategories(QList<Syndication::CategoryPtr> categories);
     QVariantList getItems(QList<Syndication::ItemPtr> items);
     QVariantList getEnclosures(QList<Syndication::EnclosurePtr> enclosures);
+    QString getThumbnailUrl(Syndication::ItemPtr item);
 };
 
 Q_DECLARE_LOGGING_CATEGORY(NEWSFEEDSENGINE)
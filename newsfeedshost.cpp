@@ -0,0 +1,129 @@
+// Loads the newsfeeds engine outside of plasmashell and keeps a list of
+// sources connected for a while, so the engine can be run under perf,
+// heaptrack or valgrind. Combined with --record and --replay it fetches
+// the same responses on every run.
+
+#include <Plasma/DataEngine>
+#include <Plasma/PluginLoader>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+#include <cstdio>
+
+class SourceListener : public QObject
+{
+    Q_OBJECT
+
+public:
+    SourceListener()
+    {
+        elapsed.start();
+    }
+
+    void printSummary()
+    {
+        QTextStream out(stdout);
+        for (auto it = updates.constBegin(); it != updates.constEnd(); ++it) {
+            out << it.key() << ": " << it.value() << " updates" << '\n';
+        }
+    }
+
+public Q_SLOTS:
+    void dataUpdated(const QString &source, const Plasma::DataEngine::Data &data)
+    {
+        ++updates[source];
+
+        QTextStream(stdout) << elapsed.elapsed() << "ms " << source
+                            << " items=" << data.value(QStringLiteral("Items")).toList().size()
+                            << " unread=" << data.value(QStringLiteral("UnreadCount")).toInt()
+                            << " bytes=" << data.value(QStringLiteral("ResidentBytes")).toLongLong()
+                            << '\n';
+    }
+
+private:
+    QElapsedTimer elapsed;
+    QHash<QString, int> updates;
+};
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("newsfeeds-host"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs the newsfeeds data engine without Plasma."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("sources"), QStringLiteral("Feed URLs to subscribe to."), QStringLiteral("<url>..."));
+    const QCommandLineOption intervalOption(QStringLiteral("interval"), QStringLiteral("Polling interval in milliseconds, 0 fetches once."), QStringLiteral("ms"), QStringLiteral("0"));
+    const QCommandLineOption durationOption(QStringLiteral("duration"), QStringLiteral("Time to run in seconds."), QStringLiteral("s"), QStringLiteral("60"));
+    const QCommandLineOption recordOption(QStringLiteral("record"), QStringLiteral("Record every response into the given directory."), QStringLiteral("dir"));
+    const QCommandLineOption replayOption(QStringLiteral("replay"), QStringLiteral("Replay responses from the given directory instead of using the network."), QStringLiteral("dir"));
+    const QCommandLineOption stateDirOption(QStringLiteral("state-dir"), QStringLiteral("Keep the engine's cache and data in the given directory instead of a temporary one."), QStringLiteral("dir"));
+    const QCommandLineOption pluginPathOption(QStringLiteral("plugin-path"), QStringLiteral("Additional directory to look for plasma/dataengine plugins in."), QStringLiteral("dir"));
+    parser.addOptions({intervalOption, durationOption, recordOption, replayOption, stateDirOption, pluginPathOption});
+    parser.process(app);
+
+    const QStringList sources = parser.positionalArguments();
+    if (sources.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    if (parser.isSet(recordOption) && parser.isSet(replayOption)) {
+        fprintf(stderr, "--record and --replay can't be used together\n");
+        return 1;
+    }
+
+    // the engine picks the corpus up from the environment
+    if (parser.isSet(recordOption)) {
+        qputenv("NEWSFEEDS_RECORD_DIR", QFile::encodeName(parser.value(recordOption)));
+    } else if (parser.isSet(replayOption)) {
+        qputenv("NEWSFEEDS_REPLAY_DIR", QFile::encodeName(parser.value(replayOption)));
+    }
+
+    // Keep the stored sources, read state, redirects and icons of the user
+    // out of the run, otherwise a replay depends on what earlier runs or
+    // plasmashell left behind.
+    QTemporaryDir temporaryStateDir;
+    const QString stateDir = parser.isSet(stateDirOption) ? parser.value(stateDirOption) : temporaryStateDir.path();
+    if (stateDir.isEmpty()) {
+        fprintf(stderr, "Couldn't create a temporary directory\n");
+        return 1;
+    }
+    qputenv("XDG_CACHE_HOME", QFile::encodeName(stateDir + QLatin1String("/cache")));
+    qputenv("XDG_DATA_HOME", QFile::encodeName(stateDir + QLatin1String("/data")));
+
+    // prefer the engine built next to this binary over an installed one
+    QCoreApplication::addLibraryPath(QCoreApplication::applicationDirPath());
+    if (parser.isSet(pluginPathOption)) {
+        QCoreApplication::addLibraryPath(parser.value(pluginPathOption));
+    }
+
+    Plasma::DataEngine *engine = Plasma::PluginLoader::self()->loadDataEngine(QStringLiteral("newsfeeds"));
+    if (engine == nullptr || !engine->isValid()) {
+        fprintf(stderr, "Couldn't load the newsfeeds data engine\n");
+        return 1;
+    }
+
+    SourceListener listener;
+    const uint interval = parser.value(intervalOption).toUInt();
+    for (const auto& source: sources) {
+        engine->connectSource(source, &listener, interval);
+    }
+
+    QTimer::singleShot(parser.value(durationOption).toInt() * 1000, &app, &QCoreApplication::quit);
+    const int result = app.exec();
+
+    listener.printSummary();
+    delete engine;
+
+    return result;
+}
+
+#include "newsfeedshost.moc"
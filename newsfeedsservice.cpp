@@ -0,0 +1,38 @@
+#include "newsfeedsservice.h"
+
+#include "newsfeedsengine.h"
+
+NewsFeedsService::NewsFeedsService(NewsFeedsEngine *engine, const QString &source)
+    : Plasma::Service(engine), engine(engine)
+{
+    setName(QStringLiteral("newsfeeds"));
+    setDestination(source);
+}
+
+Plasma::ServiceJob *NewsFeedsService::createJob(const QString &operation, QMap<QString, QVariant> &parameters)
+{
+    return new NewsFeedsJob(engine, destination(), operation, parameters, this);
+}
+
+NewsFeedsJob::NewsFeedsJob(NewsFeedsEngine *engine, const QString &source, const QString &operation,
+                           const QMap<QString, QVariant> &parameters, QObject *parent)
+    : Plasma::ServiceJob(source, operation, parameters, parent), engine(engine)
+{
+}
+
+void NewsFeedsJob::start()
+{
+    if (!engine) {
+        setResult(false);
+        return;
+    }
+
+    const QString op = operationName();
+    if (op == QLatin1String("markRead")) {
+        setResult(engine->markItemRead(destination(), parameters().value(QStringLiteral("Id")).toString()));
+    } else if (op == QLatin1String("markAllRead")) {
+        setResult(engine->markAllItemsRead(destination()));
+    } else {
+        setResult(false);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef NEWSFEEDSSERVICE_H
+#define NEWSFEEDSSERVICE_H
+
+#include <Plasma/Service>
+#include <Plasma/ServiceJob>
+
+#include <QString>
+#include <QVariantMap>
+#include <QPointer>
+
+class NewsFeedsEngine;
+
+/**
+ * Service for a single news feed source, allows marking its items as read.
+ */
+class NewsFeedsService : public Plasma::Service
+{
+    Q_OBJECT
+
+public:
+    NewsFeedsService(NewsFeedsEngine *engine, const QString &source);
+
+protected:
+    Plasma::ServiceJob *createJob(const QString &operation, QMap<QString, QVariant> &parameters) override;
+
+private:
+    QPointer<NewsFeedsEngine> engine;
+};
+
+class NewsFeedsJob : public Plasma::ServiceJob
+{
+    Q_OBJECT
+
+public:
+    NewsFeedsJob(NewsFeedsEngine *engine, const QString &source, const QString &operation,
+                 const QMap<QString, QVariant> &parameters, QObject *parent = nullptr);
+
+    void start() override;
+
+private:
+    QPointer<NewsFeedsEngine> engine;
+};
+
+#endif // NEWSFEEDSSERVICE_H
@@ -0,0 +1,142 @@
+#include "payloadstore.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QVariantMap>
+#include <QVariantHash>
+
+#define PAYLOAD_FORMAT_VERSION 1
+#define MAXIMUM_PAYLOAD_AGE 2592000 // 30 days
+
+PayloadStore::PayloadStore()
+    : storageDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/plasma_engine_newsfeeds/sources/"))
+{
+}
+
+bool PayloadStore::saveData(const QString &source, const QVariantHash &data)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_5);
+    out << data;
+
+    ensureStorageExists();
+    const QString localPath = storagePathForSource(source);
+    QSaveFile saveFile(localPath);
+    if (!saveFile.open(QIODevice::WriteOnly)) {
+        qCDebug(PAYLOADSTORE) << "Couldn't open file" << localPath;
+        return false;
+    }
+
+    QDataStream file(&saveFile);
+    file.setVersion(QDataStream::Qt_5_5);
+    file << (quint32) PAYLOAD_FORMAT_VERSION << source << qCompress(payload);
+
+    if (!saveFile.commit()) {
+        qCDebug(PAYLOADSTORE) << "Couldn't write file" << localPath;
+        return false;
+    }
+
+    return true;
+}
+
+bool PayloadStore::loadData(const QString &source, QVariantHash *data)
+{
+    const QString localPath = storagePathForSource(source);
+    QFile file(localPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_5);
+
+    quint32 version;
+    QString storedSource;
+    QByteArray compressed;
+    in >> version >> storedSource >> compressed;
+    if (in.status() != QDataStream::Ok || version != PAYLOAD_FORMAT_VERSION || storedSource != source) {
+        qCDebug(PAYLOADSTORE) << "Ignoring unusable file" << localPath;
+        return false;
+    }
+
+    const QByteArray payload = qUncompress(compressed);
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_5_5);
+    stream >> *data;
+
+    return stream.status() == QDataStream::Ok;
+}
+
+void PayloadStore::prune()
+{
+    const QDateTime oldest = QDateTime::currentDateTime().addSecs(-MAXIMUM_PAYLOAD_AGE);
+    const QFileInfoList files = QDir(storageDir).entryInfoList({QStringLiteral("*.data")}, QDir::Files);
+    for (const auto& file: files) {
+        if (file.lastModified() < oldest) {
+            qCDebug(PAYLOADSTORE) << "Removing unused file" << file.fileName();
+            QFile::remove(file.absoluteFilePath());
+        }
+    }
+}
+
+qint64 PayloadStore::estimateSize(const QVariant &value)
+{
+    // approximate overhead of a QVariant and the implicitly shared data it points to
+    qint64 size = sizeof(QVariant) + 16;
+
+    switch (value.type()) {
+    case QVariant::String:
+        size += value.toString().size() * sizeof(QChar);
+        break;
+    case QVariant::ByteArray:
+        size += value.toByteArray().size();
+        break;
+    case QVariant::Url:
+        size += value.toUrl().toString().size() * sizeof(QChar);
+        break;
+    case QVariant::List:
+        for (const auto& v: value.toList()) {
+            size += estimateSize(v);
+        }
+        break;
+    case QVariant::Map: {
+        const QVariantMap map = value.toMap();
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            size += it.key().size() * sizeof(QChar) + estimateSize(it.value());
+        }
+        break;
+    }
+    case QVariant::Hash: {
+        const QVariantHash hash = value.toHash();
+        for (auto it = hash.constBegin(); it != hash.constEnd(); ++it) {
+            size += it.key().size() * sizeof(QChar) + estimateSize(it.value());
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    return size;
+}
+
+QString PayloadStore::storagePathForSource(const QString &source)
+{
+    const QByteArray name = QCryptographicHash::hash(source.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return storageDir + QString::fromLatin1(name) + QLatin1String(".data");
+}
+
+void PayloadStore::ensureStorageExists()
+{
+    QDir().mkpath(storageDir);
+}
+
+Q_LOGGING_CATEGORY(PAYLOADSTORE, "payloadstore")
@@ -0,0 +1,46 @@
+#ifndef PAYLOADSTORE_H
+#define PAYLOADSTORE_H
+
+#include <QString>
+#include <QVariant>
+#include <QVariantHash>
+#include <QLoggingCategory>
+
+/**
+ * Keeps a compact on-disk copy of the data of every source, so that item
+ * bodies can be dropped from memory and a source can be brought back later
+ * without having to fetch the feed again.
+ *
+ * The store holds no state besides its location, copies of it may be used
+ * from worker threads.
+ */
+class PayloadStore
+{
+public:
+    PayloadStore();
+
+    bool saveData(const QString &source, const QVariantHash &data);
+    bool loadData(const QString &source, QVariantHash *data);
+
+    /**
+     * Removes the copies of sources which were not saved for a long time,
+     * usually because nobody requested them anymore.
+     */
+    void prune();
+
+    /**
+     * @return A rough estimate of the number of bytes @p value occupies
+     * in memory.
+     */
+    static qint64 estimateSize(const QVariant &value);
+
+private:
+    void ensureStorageExists();
+    QString storagePathForSource(const QString &source);
+
+    QString storageDir;
+};
+
+Q_DECLARE_LOGGING_CATEGORY(PAYLOADSTORE)
+
+#endif // PAYLOADSTORE_H
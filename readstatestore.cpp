@@ -0,0 +1,169 @@
+#include "readstatestore.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <algorithm>
+#include <cstring>
+
+#define READSTATE_FORMAT_VERSION 1
+#define MAXIMUM_READ_ITEMS 50000
+#define MAXIMUM_READ_AGE 7776000 // 90 days
+#define REFRESH_INTERVAL 86400 // 1 day
+
+ReadStateStore::ReadStateStore()
+    : storageDir(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/plasma_engine_newsfeeds/")),
+      unsavedChanges(false)
+{
+}
+
+bool ReadStateStore::isRead(const QString &source, const QString &itemId)
+{
+    auto it = readItems.find(keyForItem(source, itemId));
+    if (it == readItems.end()) {
+        return false;
+    }
+
+    // items still present in a feed must not age out, refreshing at most
+    // once a day keeps the number of saves low
+    const qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    if (now - *it > REFRESH_INTERVAL) {
+        *it = now;
+        unsavedChanges = true;
+    }
+    return true;
+}
+
+bool ReadStateStore::markRead(const QString &source, const QString &itemId)
+{
+    const quint64 key = keyForItem(source, itemId);
+    const bool wasRead = readItems.contains(key);
+    readItems.insert(key, QDateTime::currentMSecsSinceEpoch() / 1000);
+    unsavedChanges = true;
+    return !wasRead;
+}
+
+bool ReadStateStore::hasUnsavedChanges() const
+{
+    return unsavedChanges;
+}
+
+bool ReadStateStore::load()
+{
+    QFile file(storageDir + QLatin1String("readstate"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_5);
+
+    quint32 version;
+    quint32 count;
+    in >> version >> count;
+    if (in.status() != QDataStream::Ok || version != READSTATE_FORMAT_VERSION) {
+        qCDebug(READSTATESTORE) << "Ignoring unusable file" << file.fileName();
+        return false;
+    }
+
+    readItems.clear();
+    readItems.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        quint64 key;
+        qint64 timestamp;
+        in >> key >> timestamp;
+        readItems.insert(key, timestamp);
+    }
+
+    prune();
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool ReadStateStore::save()
+{
+    prune();
+
+    ensureStorageExists();
+    const QString localPath = storageDir + QLatin1String("readstate");
+    QSaveFile saveFile(localPath);
+    if (!saveFile.open(QIODevice::WriteOnly)) {
+        qCDebug(READSTATESTORE) << "Couldn't open file" << localPath;
+        return false;
+    }
+
+    QDataStream out(&saveFile);
+    out.setVersion(QDataStream::Qt_5_5);
+    out << (quint32) READSTATE_FORMAT_VERSION << (quint32) readItems.size();
+    for (auto it = readItems.constBegin(); it != readItems.constEnd(); ++it) {
+        out << it.key() << it.value();
+    }
+
+    if (!saveFile.commit()) {
+        qCDebug(READSTATESTORE) << "Couldn't write file" << localPath;
+        return false;
+    }
+
+    unsavedChanges = false;
+    return true;
+}
+
+quint64 ReadStateStore::keyForItem(const QString &source, const QString &itemId)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(source.toUtf8());
+    hash.addData("\n", 1);
+    hash.addData(itemId.toUtf8());
+
+    quint64 key;
+    memcpy(&key, hash.result().constData(), sizeof(key));
+    return key;
+}
+
+void ReadStateStore::prune()
+{
+    const qint64 oldest = QDateTime::currentMSecsSinceEpoch() / 1000 - MAXIMUM_READ_AGE;
+    for (auto it = readItems.begin(); it != readItems.end();) {
+        if (it.value() < oldest) {
+            it = readItems.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (readItems.size() <= MAXIMUM_READ_ITEMS) {
+        return;
+    }
+
+    QVector<qint64> timestamps;
+    timestamps.reserve(readItems.size());
+    for (const auto& timestamp: readItems) {
+        timestamps.append(timestamp);
+    }
+
+    // keep the newest MAXIMUM_READ_ITEMS entries
+    auto cutoff = timestamps.end() - MAXIMUM_READ_ITEMS;
+    std::nth_element(timestamps.begin(), cutoff, timestamps.end());
+    const qint64 threshold = *cutoff;
+
+    for (auto it = readItems.begin(); it != readItems.end() && readItems.size() > MAXIMUM_READ_ITEMS;) {
+        if (it.value() < threshold) {
+            it = readItems.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ReadStateStore::ensureStorageExists()
+{
+    QDir().mkpath(storageDir);
+}
+
+Q_LOGGING_CATEGORY(READSTATESTORE, "readstatestore")
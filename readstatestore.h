@@ -0,0 +1,48 @@
+#ifndef READSTATESTORE_H
+#define READSTATESTORE_H
+
+#include <QString>
+#include <QHash>
+#include <QLoggingCategory>
+
+/**
+ * Remembers which items were read.
+ *
+ * Only a 64 bit hash of the source and the item id is kept for every read
+ * item, together with the time it was last seen as read. Entries older than
+ * the maximum age are pruned and the number of entries is bounded, dropping
+ * the oldest ones first.
+ */
+class ReadStateStore
+{
+public:
+    ReadStateStore();
+
+    bool isRead(const QString &source, const QString &itemId);
+
+    /**
+     * @return true if the item was not read before.
+     */
+    bool markRead(const QString &source, const QString &itemId);
+
+    /**
+     * @return true if entries were marked or refreshed since the last save.
+     */
+    bool hasUnsavedChanges() const;
+
+    bool load();
+    bool save();
+
+private:
+    static quint64 keyForItem(const QString &source, const QString &itemId);
+    void prune();
+    void ensureStorageExists();
+
+    QString storageDir;
+    QHash<quint64, qint64> readItems;
+    bool unsavedChanges;
+};
+
+Q_DECLARE_LOGGING_CATEGORY(READSTATESTORE)
+
+#endif // READSTATESTORE_H
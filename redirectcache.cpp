@@ -0,0 +1,173 @@
+#include "redirectcache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#define REDIRECTS_FORMAT_VERSION 1
+#define MAXIMUM_REDIRECTS 10
+
+RedirectCache *RedirectCache::instance()
+{
+    static RedirectCache cache;
+    return &cache;
+}
+
+RedirectCache::RedirectCache()
+    : storageDir(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/plasma_engine_newsfeeds/"))
+{
+    load();
+}
+
+QUrl RedirectCache::resolve(const QUrl &url) const
+{
+    return redirects.value(url, url);
+}
+
+void RedirectCache::insert(const QUrl &url, const QUrl &target)
+{
+    if (url == target || redirects.value(url) == target) {
+        return;
+    }
+
+    qCDebug(REDIRECTCACHE) << "Remembering redirect from" << url << "to" << target;
+    redirects.insert(url, target);
+    save();
+}
+
+void RedirectCache::invalidate(const QUrl &url)
+{
+    if (redirects.remove(url) > 0) {
+        qCDebug(REDIRECTCACHE) << "Forgetting redirect from" << url;
+        save();
+    }
+}
+
+bool RedirectCache::isRedirect(int httpStatusCode)
+{
+    return httpStatusCode == 301 || httpStatusCode == 302 || httpStatusCode == 303
+        || httpStatusCode == 307 || httpStatusCode == 308;
+}
+
+bool RedirectCache::isPermanentRedirect(int httpStatusCode)
+{
+    return httpStatusCode == 301 || httpStatusCode == 308;
+}
+
+void RedirectCache::load()
+{
+    QFile file(storageDir + QLatin1String("redirects"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_5);
+
+    quint32 version;
+    QHash<QUrl, QUrl> stored;
+    in >> version >> stored;
+    if (in.status() != QDataStream::Ok || version != REDIRECTS_FORMAT_VERSION) {
+        qCDebug(REDIRECTCACHE) << "Ignoring unusable file" << file.fileName();
+        return;
+    }
+
+    redirects = stored;
+}
+
+void RedirectCache::save()
+{
+    QDir().mkpath(storageDir);
+    const QString localPath = storageDir + QLatin1String("redirects");
+    QSaveFile saveFile(localPath);
+    if (!saveFile.open(QIODevice::WriteOnly)) {
+        qCDebug(REDIRECTCACHE) << "Couldn't open file" << localPath;
+        return;
+    }
+
+    QDataStream out(&saveFile);
+    out.setVersion(QDataStream::Qt_5_5);
+    out << (quint32) REDIRECTS_FORMAT_VERSION << redirects;
+
+    if (!saveFile.commit()) {
+        qCDebug(REDIRECTCACHE) << "Couldn't write file" << localPath;
+    }
+}
+
+RedirectChain::RedirectChain()
+    : redirects(0), usingCachedRedirect(false), permanent(true)
+{
+}
+
+void RedirectChain::start(const QUrl &url)
+{
+    this->url = url;
+    currentUrl = RedirectCache::instance()->resolve(url);
+    usingCachedRedirect = currentUrl != url;
+    redirects = 0;
+    permanent = true;
+}
+
+bool RedirectChain::next(QNetworkReply *reply, int *errorCode)
+{
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const QUrl target = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+
+    if (RedirectCache::isRedirect(statusCode) && target.isValid()) {
+        const QUrl nextUrl = reply->url().resolved(target);
+        if (redirects >= MAXIMUM_REDIRECTS) {
+            qCWarning(REDIRECTCACHE) << "Too many redirects for" << url;
+            *errorCode = QNetworkReply::TooManyRedirectsError;
+            return false;
+        }
+        if (nextUrl.scheme() != QLatin1String("http") && nextUrl.scheme() != QLatin1String("https")) {
+            // never let a server point a download at local files or other protocols
+            qCWarning(REDIRECTCACHE) << "Refusing redirect from" << currentUrl << "to" << nextUrl;
+            *errorCode = QNetworkReply::ProtocolUnknownError;
+            return false;
+        }
+        if (currentUrl.scheme() == QLatin1String("https") && nextUrl.scheme() != QLatin1String("https")) {
+            qCWarning(REDIRECTCACHE) << "Refusing insecure redirect from" << currentUrl << "to" << nextUrl;
+            *errorCode = QNetworkReply::InsecureRedirectError;
+            return false;
+        }
+
+        qCDebug(REDIRECTCACHE) << "Redirected from" << currentUrl << "to" << nextUrl << "with status" << statusCode;
+
+        permanent = permanent && RedirectCache::isPermanentRedirect(statusCode);
+        currentUrl = nextUrl;
+        ++redirects;
+        return true;
+    }
+
+    // only an HTTP error means the target moved on, network errors happen
+    // when offline as well
+    if (*errorCode != QNetworkReply::NoError && usingCachedRedirect && statusCode >= 400) {
+        RedirectCache::instance()->invalidate(url);
+        start(url);
+        usingCachedRedirect = false;
+        return true;
+    }
+
+    if (*errorCode == QNetworkReply::NoError && redirects > 0 && permanent) {
+        RedirectCache::instance()->insert(url, currentUrl);
+    }
+
+    return false;
+}
+
+QUrl RedirectChain::effectiveUrl() const
+{
+    return currentUrl;
+}
+
+int RedirectChain::redirectCount() const
+{
+    return redirects;
+}
+
+Q_LOGGING_CATEGORY(REDIRECTCACHE, "redirectcache")
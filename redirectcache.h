@@ -0,0 +1,88 @@
+#ifndef REDIRECTCACHE_H
+#define REDIRECTCACHE_H
+
+#include <QUrl>
+#include <QString>
+#include <QHash>
+#include <QLoggingCategory>
+
+class QNetworkReply;
+
+/**
+ * Remembers where feeds and icons moved to.
+ *
+ * Only redirect chains made of permanent redirects (301 and 308) are
+ * remembered, so later requests can go to the final URL directly. An entry
+ * has to be invalidated when its target answers with an HTTP error, the
+ * original URL is used again then. The map is kept on disk and shared by
+ * all downloads.
+ */
+class RedirectCache
+{
+public:
+    static RedirectCache *instance();
+
+    /**
+     * @return The URL @p url permanently redirects to or @p url itself.
+     */
+    QUrl resolve(const QUrl &url) const;
+
+    void insert(const QUrl &url, const QUrl &target);
+    void invalidate(const QUrl &url);
+
+    static bool isRedirect(int httpStatusCode);
+    static bool isPermanentRedirect(int httpStatusCode);
+
+private:
+    RedirectCache();
+
+    void load();
+    void save();
+
+    QString storageDir;
+    QHash<QUrl, QUrl> redirects;
+};
+
+/**
+ * Follows the redirects of a single download by hand, so the status of
+ * every hop is known, and keeps the RedirectCache up to date with what it
+ * learns on the way.
+ */
+class RedirectChain
+{
+public:
+    RedirectChain();
+
+    /**
+     * Starts a new chain for @p url, going straight to the target
+     * remembered for it if there is one.
+     */
+    void start(const QUrl &url);
+
+    /**
+     * Looks at a finished reply of the chain.
+     * @param errorCode The error of the reply, changed when a redirect
+     * has to be refused.
+     * @return true if effectiveUrl() has to be requested next.
+     */
+    bool next(QNetworkReply *reply, int *errorCode);
+
+    QUrl effectiveUrl() const;
+
+    /**
+     * @return The number of redirects followed, redirects remembered from
+     * earlier downloads are not counted.
+     */
+    int redirectCount() const;
+
+private:
+    QUrl url;
+    QUrl currentUrl;
+    int redirects;
+    bool usingCachedRedirect;
+    bool permanent;
+};
+
+Q_DECLARE_LOGGING_CATEGORY(REDIRECTCACHE)
+
+#endif // REDIRECTCACHE_H
@@ -0,0 +1,224 @@
+#include "replaycorpus.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QTimer>
+
+#include <cstring>
+
+#define CORPUS_FORMAT_VERSION 1
+
+/**
+ * Reply handing out a recorded response as if it came from the network.
+ */
+class ReplayReply : public QNetworkReply
+{
+public:
+    ReplayReply(const QNetworkRequest &request, int errorCode, int statusCode,
+                const QUrl &redirectTarget, const QByteArray &data, QObject *parent)
+        : QNetworkReply(parent), data(data), offset(0)
+    {
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(QNetworkAccessManager::GetOperation);
+        if (statusCode != 0) {
+            setAttribute(QNetworkRequest::HttpStatusCodeAttribute, statusCode);
+        }
+        if (redirectTarget.isValid()) {
+            setAttribute(QNetworkRequest::RedirectionTargetAttribute, redirectTarget);
+        }
+        if (errorCode != QNetworkReply::NoError) {
+            setError(static_cast<QNetworkReply::NetworkError>(errorCode), QStringLiteral("Replayed error"));
+        }
+        setHeader(QNetworkRequest::ContentLengthHeader, data.size());
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+        // the caller connects to the reply only after it is returned
+        QTimer::singleShot(0, this, [this]() { deliver(); });
+    }
+
+    void abort() override
+    {
+        if (isFinished()) {
+            return;
+        }
+        setError(QNetworkReply::OperationCanceledError, QStringLiteral("Operation canceled"));
+        finish();
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        return data.size() - offset + QIODevice::bytesAvailable();
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+protected:
+    qint64 readData(char *buffer, qint64 maxSize) override
+    {
+        const qint64 size = qMin(maxSize, qint64(data.size()) - offset);
+        memcpy(buffer, data.constData() + offset, size);
+        offset += size;
+        return size;
+    }
+
+private:
+    void deliver()
+    {
+        if (isFinished()) {
+            return;
+        }
+
+        emit metaDataChanged();
+        emit downloadProgress(data.size(), data.size());
+        if (!data.isEmpty() && !isFinished()) {
+            emit readyRead();
+        }
+        if (!isFinished()) {
+            finish();
+        }
+    }
+
+    void finish()
+    {
+        setFinished(true);
+        emit finished();
+    }
+
+    QByteArray data;
+    qint64 offset;
+};
+
+ReplayCorpus *ReplayCorpus::instance()
+{
+    static ReplayCorpus corpus;
+    return &corpus;
+}
+
+ReplayCorpus::ReplayCorpus()
+    : corpusMode(Disabled)
+{
+    if (qEnvironmentVariableIsSet("NEWSFEEDS_REPLAY_DIR")) {
+        corpusMode = Replay;
+        storageDir = QFile::decodeName(qgetenv("NEWSFEEDS_REPLAY_DIR"));
+    } else if (qEnvironmentVariableIsSet("NEWSFEEDS_RECORD_DIR")) {
+        corpusMode = Record;
+        storageDir = QFile::decodeName(qgetenv("NEWSFEEDS_RECORD_DIR"));
+        QDir().mkpath(storageDir);
+    }
+
+    if (corpusMode != Disabled) {
+        storageDir = QDir(storageDir).absolutePath() + QLatin1Char('/');
+        qCDebug(REPLAYCORPUS) << (corpusMode == Replay ? "Replaying from" : "Recording into") << storageDir;
+    }
+}
+
+ReplayCorpus::Mode ReplayCorpus::mode() const
+{
+    return corpusMode;
+}
+
+void ReplayCorpus::record(const QUrl &url, QNetworkReply *reply, const QByteArray &data)
+{
+    if (corpusMode != Record) {
+        return;
+    }
+
+    const int errorCode = reply->error();
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const QUrl redirectTarget = reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+
+    const int sequence = sequences.value(url);
+    sequences.insert(url, sequence + 1);
+
+    const QString localPath = storagePathForResponse(url, sequence);
+    QSaveFile saveFile(localPath);
+    if (!saveFile.open(QIODevice::WriteOnly)) {
+        qCWarning(REPLAYCORPUS) << "Couldn't open file" << localPath;
+        return;
+    }
+
+    QDataStream out(&saveFile);
+    out.setVersion(QDataStream::Qt_5_5);
+    out << (quint32) CORPUS_FORMAT_VERSION << url << (qint32) errorCode << (qint32) statusCode
+        << redirectTarget << data;
+    if (!saveFile.commit()) {
+        qCWarning(REPLAYCORPUS) << "Couldn't write file" << localPath;
+        return;
+    }
+
+    // human readable list of the recorded responses
+    QFile index(storageDir + QLatin1String("index.txt"));
+    if (index.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        QTextStream(&index) << QFileInfo(localPath).fileName() << ' ' << errorCode << ' ' << statusCode << ' '
+                            << data.size() << ' ' << url.toString() << '\n';
+    }
+}
+
+QNetworkReply *ReplayCorpus::replay(const QNetworkRequest &request, QObject *parent)
+{
+    const QUrl url = request.url();
+    qCDebug(REPLAYCORPUS) << "replaying" << url;
+
+    int sequence = sequences.value(url);
+    if (!QFile::exists(storagePathForResponse(url, sequence)) && sequence > 0) {
+        // repeat the last recorded response
+        --sequence;
+    }
+    sequences.insert(url, sequence + 1);
+
+    QFile file(storagePathForResponse(url, sequence));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(REPLAYCORPUS) << "No response recorded for" << url;
+        return new ReplayReply(request, QNetworkReply::HostNotFoundError, 0, QUrl(), QByteArray(), parent);
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_5);
+
+    quint32 version;
+    QUrl storedUrl;
+    qint32 errorCode;
+    qint32 statusCode;
+    QUrl redirectTarget;
+    QByteArray data;
+    in >> version >> storedUrl >> errorCode >> statusCode >> redirectTarget >> data;
+    if (in.status() != QDataStream::Ok || version != CORPUS_FORMAT_VERSION || storedUrl != url) {
+        qCWarning(REPLAYCORPUS) << "Ignoring unusable file" << file.fileName();
+        return new ReplayReply(request, QNetworkReply::HostNotFoundError, 0, QUrl(), QByteArray(), parent);
+    }
+
+    return new ReplayReply(request, errorCode, statusCode, redirectTarget, data, parent);
+}
+
+QString ReplayCorpus::storagePathForResponse(const QUrl &url, int sequence) const
+{
+    const QByteArray name = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha1).toHex();
+    return storageDir + QString::fromLatin1(name) + QLatin1Char('-') + QString::number(sequence) + QLatin1String(".response");
+}
+
+CorpusNetworkAccessManager::CorpusNetworkAccessManager(QObject *parent)
+    : QNetworkAccessManager(parent)
+{
+}
+
+QNetworkReply *CorpusNetworkAccessManager::createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData)
+{
+    if (op == GetOperation && ReplayCorpus::instance()->mode() == ReplayCorpus::Replay) {
+        return ReplayCorpus::instance()->replay(request, this);
+    }
+
+    return QNetworkAccessManager::createRequest(op, request, outgoingData);
+}
+
+Q_LOGGING_CATEGORY(REPLAYCORPUS, "replaycorpus")
@@ -0,0 +1,76 @@
+#ifndef REPLAYCORPUS_H
+#define REPLAYCORPUS_H
+
+#include <QUrl>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QLoggingCategory>
+
+class QNetworkReply;
+class QNetworkRequest;
+
+/**
+ * Records HTTP responses into a directory or replays them from it, so the
+ * engine can be profiled with a reproducible load and without network.
+ *
+ * The mode is chosen by the NEWSFEEDS_RECORD_DIR and NEWSFEEDS_REPLAY_DIR
+ * environment variables; with neither set the corpus is disabled. Every
+ * response is recorded, redirects included, and every response to the same
+ * URL is kept in order. On replay the n-th request of a URL gets the n-th
+ * recorded response, the last one being repeated when the corpus runs out.
+ */
+class ReplayCorpus
+{
+public:
+    enum Mode {
+        Disabled,
+        Record,
+        Replay
+    };
+
+    static ReplayCorpus *instance();
+
+    Mode mode() const;
+
+    /**
+     * Records the finished @p reply to a request of @p url.
+     * @param data The body of the reply, which was read already.
+     */
+    void record(const QUrl &url, QNetworkReply *reply, const QByteArray &data);
+
+    /**
+     * @return A finished reply with the response recorded for the request,
+     * or one failing with QNetworkReply::HostNotFoundError if nothing was
+     * recorded for its URL.
+     */
+    QNetworkReply *replay(const QNetworkRequest &request, QObject *parent);
+
+private:
+    ReplayCorpus();
+
+    QString storagePathForResponse(const QUrl &url, int sequence) const;
+
+    Mode corpusMode;
+    QString storageDir;
+    QHash<QUrl, int> sequences;
+};
+
+/**
+ * Network access manager for all downloads of the engine. When replaying,
+ * requests are answered from the ReplayCorpus, so replies go through the
+ * same code as ones coming from the network.
+ */
+class CorpusNetworkAccessManager : public QNetworkAccessManager
+{
+public:
+    explicit CorpusNetworkAccessManager(QObject *parent = nullptr);
+
+protected:
+    QNetworkReply *createRequest(Operation op, const QNetworkRequest &request, QIODevice *outgoingData = nullptr) override;
+};
+
+Q_DECLARE_LOGGING_CATEGORY(REPLAYCORPUS)
+
+#endif // REPLAYCORPUS_H